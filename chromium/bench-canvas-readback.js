@@ -0,0 +1,148 @@
+#!/usr/bin/env node
+
+/**
+ * Canvas Readback Noise Benchmark
+ *
+ * Times toDataURL() on GPU-accelerated and software canvases of the
+ * patched build, and checks that both get the same noise. Runs on
+ * SwiftShader so no GPU is needed.
+ *
+ * Usage:
+ *   node bench-canvas-readback.js /path/to/chromium/chrome [iterations]
+ */
+
+const puppeteer = require('puppeteer-core');
+const fs = require('fs');
+
+const SIZES = [256, 1024, 2048];
+
+// Colors for output
+const colors = {
+  reset: '\x1b[0m',
+  green: '\x1b[32m',
+  red: '\x1b[31m',
+  blue: '\x1b[34m',
+};
+
+function log(message, color = colors.reset) {
+  console.log(`${color}${message}${colors.reset}`);
+}
+
+async function benchmarkSize(page, size, iterations) {
+  return page.evaluate((size, iterations) => {
+    // Integer-aligned solid fills rasterize identically on GPU and CPU, so
+    // any difference between the two data URLs comes from the noise path.
+    function draw(ctx, frame) {
+      ctx.fillStyle = '#3366cc';
+      ctx.fillRect(0, 0, size, size);
+      ctx.fillStyle = '#cc3333';
+      ctx.fillRect(size / 4, size / 4, size / 2, size / 2);
+      ctx.fillStyle = `rgb(${frame % 256}, 0, 0)`;
+      ctx.fillRect(0, 0, 1, 1);
+    }
+
+    function run(willReadFrequently) {
+      const canvas = document.createElement('canvas');
+      canvas.width = size;
+      canvas.height = size;
+      const ctx = canvas.getContext('2d', { willReadFrequently });
+      draw(ctx, 0);
+
+      // Unchanged canvas: served from the readback cache after the first call
+      let start = performance.now();
+      const url = canvas.toDataURL();
+      for (let i = 1; i < iterations; i++) {
+        canvas.toDataURL();
+      }
+      const unchangedMs = (performance.now() - start) / iterations;
+
+      // Redrawn canvas: readback, noise and encode on every call
+      start = performance.now();
+      for (let i = 1; i <= iterations; i++) {
+        draw(ctx, i);
+        canvas.toDataURL();
+      }
+      const redrawnMs = (performance.now() - start) / iterations;
+
+      // Noise check: a solid fill should come back with some pixels moved
+      const pixels = ctx.getImageData(0, 0, size, size / 8).data;
+      let noised = 0;
+      for (let i = 4; i < pixels.length; i += 4) {
+        if (pixels[i] !== 0x33 || pixels[i + 1] !== 0x66 || pixels[i + 2] !== 0xcc) {
+          noised++;
+        }
+      }
+
+      return { url, unchangedMs, redrawnMs, noised };
+    }
+
+    const gpu = run(false);
+    const cpu = run(true);
+    return {
+      gpu: { unchangedMs: gpu.unchangedMs, redrawnMs: gpu.redrawnMs, noised: gpu.noised },
+      cpu: { unchangedMs: cpu.unchangedMs, redrawnMs: cpu.redrawnMs, noised: cpu.noised },
+      sameNoise: gpu.url === cpu.url,
+    };
+  }, size, iterations);
+}
+
+async function runBenchmark(chromiumPath, iterations) {
+  if (!fs.existsSync(chromiumPath)) {
+    log(`✗ Chromium not found at: ${chromiumPath}`, colors.red);
+    process.exit(1);
+  }
+
+  const browser = await puppeteer.launch({
+    executablePath: chromiumPath,
+    headless: 'new',
+    args: [
+      '--no-sandbox',
+      '--disable-setuid-sandbox',
+      '--use-gl=swiftshader',
+      '--ignore-gpu-blocklist',
+      '--enable-gpu-rasterization',
+    ],
+  });
+
+  let failed = false;
+  try {
+    const page = await browser.newPage();
+    await page.goto('about:blank');
+
+    log(`ℹ ${iterations} iterations per case, SwiftShader GL`, colors.blue);
+    log('size   canvas  unchanged(ms)  redrawn(ms)  noised px');
+    for (const size of SIZES) {
+      const result = await benchmarkSize(page, size, iterations);
+      for (const kind of ['gpu', 'cpu']) {
+        const r = result[kind];
+        log(`${String(size).padEnd(6)} ${kind.padEnd(7)} ` +
+            `${r.unchangedMs.toFixed(3).padStart(13)}  ` +
+            `${r.redrawnMs.toFixed(3).padStart(11)}  ${String(r.noised).padStart(9)}`);
+        if (r.noised === 0) {
+          failed = true;
+        }
+      }
+      if (!result.sameNoise) {
+        log(`✗ ${size}px: accelerated and software toDataURL differ`, colors.red);
+        failed = true;
+      }
+    }
+  } finally {
+    await browser.close();
+  }
+
+  if (failed) {
+    log('\n✗ Canvas noise missing or inconsistent', colors.red);
+    process.exit(1);
+  }
+  log('\n✓ Accelerated and software canvases carry the same noise', colors.green);
+}
+
+// Main
+const chromiumPath = process.argv[2] || '/usr/bin/chromium';
+const iterations = parseInt(process.argv[3] || '20', 10);
+runBenchmark(chromiumPath, iterations).catch(error => {
+  log(`\n✗ Error running benchmark: ${error.message}`, colors.red);
+  console.error(error);
+  process.exit(1);
+});
@@ -0,0 +1,254 @@
+#!/usr/bin/env node
+
+/**
+ * Fingerprint Identity Density Benchmark
+ *
+ * Reports memory per fingerprint identity at 1, 10 and 50 identities, two
+ * ways: one browser per identity, and one browser hosting every identity in
+ * its own off-the-record BrowserContext, bound over
+ * --fingerprint-pool-socket. Memory is the PSS of the browser's whole
+ * process tree, so pages shared between processes are split between them
+ * rather than counted in each. Linux only.
+ *
+ * Usage:
+ *   node bench-context-density.js /path/to/chromium/chrome [counts]
+ *
+ * counts is a comma-separated list of identity counts (default 1,10,50).
+ */
+
+const puppeteer = require('puppeteer-core');
+const fs = require('fs');
+const net = require('net');
+const os = require('os');
+const path = require('path');
+
+const URL = 'data:text/html,<title>identity</title>';
+
+// Not one of the values the browser picks when it has no profile, so a
+// page reporting it got its identity
+const HARDWARE_CONCURRENCY = 6;
+
+// FingerprintPoolBinding, see
+// content/browser/fingerprint/fingerprint_pool_binder.h. Host byte order;
+// every platform this runs on is little-endian.
+const BINDING_MAGIC = 0x42504455;  // "UDPB"
+const BINDING_VERSION = 2;
+const BINDING_HEADER_SIZE = 80;
+const BINDING_CONTEXT_ID_OFFSET = 16;
+const BINDING_CONTEXT_ID_SIZE = 64;
+
+// Lets renderers finish their first paint before memory is read
+const SETTLE_MS = 2000;
+
+// Colors for output
+const colors = {
+  reset: '\x1b[0m',
+  green: '\x1b[32m',
+  red: '\x1b[31m',
+  blue: '\x1b[34m',
+};
+
+function log(message, color = colors.reset) {
+  console.log(`${color}${message}${colors.reset}`);
+}
+
+function launch(chromiumPath, args) {
+  return puppeteer.launch({
+    executablePath: chromiumPath,
+    headless: 'new',
+    args: ['--no-sandbox', '--disable-setuid-sandbox', ...args],
+  });
+}
+
+async function waitForFile(file, timeoutMs = 10000) {
+  const deadline = Date.now() + timeoutMs;
+  while (!fs.existsSync(file)) {
+    if (Date.now() > deadline) {
+      throw new Error(`${file} did not appear`);
+    }
+    await new Promise(resolve => setTimeout(resolve, 10));
+  }
+}
+
+// Has the browser turn a JSON profile into the binary one a binding carries
+async function writeProfiles(chromiumPath, dir) {
+  const json = path.join(dir, 'profile.json');
+  const binary = path.join(dir, 'profile.fpb');
+  fs.writeFileSync(json, JSON.stringify({
+    navigator: { hardwareConcurrency: HARDWARE_CONCURRENCY },
+  }));
+  const browser = await launch(chromiumPath, [
+    `--fingerprint-config=${json}`,
+    `--fingerprint-write-profile=${binary}`,
+  ]);
+  await browser.close();
+  await waitForFile(binary);
+  return { json, profile: fs.readFileSync(binary) };
+}
+
+function bind(socketPath, profile, seed, contextId) {
+  const header = Buffer.alloc(BINDING_HEADER_SIZE);
+  header.writeUInt32LE(BINDING_MAGIC, 0);
+  header.writeUInt32LE(BINDING_VERSION, 4);
+  header.writeBigUInt64LE(seed, 8);
+  if (Buffer.byteLength(contextId) >= BINDING_CONTEXT_ID_SIZE) {
+    throw new Error(`Browser context id too long: ${contextId}`);
+  }
+  header.write(contextId, BINDING_CONTEXT_ID_OFFSET);
+
+  return new Promise((resolve, reject) => {
+    let reply = '';
+    const socket = net.connect(socketPath, () => {
+      socket.write(Buffer.concat([header, profile]));
+    });
+    socket.on('data', data => {
+      reply += data;
+      if (reply.endsWith('\n')) {
+        socket.destroy();
+        if (reply === 'OK\n') {
+          resolve();
+        } else {
+          reject(new Error(`Binding rejected: ${reply.trim()}`));
+        }
+      }
+    });
+    socket.on('error', reject);
+  });
+}
+
+// PSS of |rootPid| and all its descendants, in KiB
+function treePssKiB(rootPid) {
+  const children = new Map();
+  for (const entry of fs.readdirSync('/proc')) {
+    if (!/^\d+$/.test(entry)) {
+      continue;
+    }
+    try {
+      const stat = fs.readFileSync(`/proc/${entry}/stat`, 'utf8');
+      // The command name may contain spaces; fields resume after its ')'
+      const fields = stat.slice(stat.lastIndexOf(')') + 2).split(' ');
+      const ppid = parseInt(fields[1], 10);
+      if (!children.has(ppid)) {
+        children.set(ppid, []);
+      }
+      children.get(ppid).push(parseInt(entry, 10));
+    } catch (error) {
+      // Exited while being listed
+    }
+  }
+
+  let total = 0;
+  const pending = [rootPid];
+  while (pending.length > 0) {
+    const pid = pending.pop();
+    try {
+      const rollup = fs.readFileSync(`/proc/${pid}/smaps_rollup`, 'utf8');
+      total += parseInt(rollup.match(/^Pss:\s+(\d+)/m)[1], 10);
+    } catch (error) {
+      // Exited while being measured
+    }
+    pending.push(...(children.get(pid) || []));
+  }
+  return total;
+}
+
+async function openIdentity(target) {
+  const page = await target.newPage();
+  await page.goto(URL);
+  return page.evaluate(() => navigator.hardwareConcurrency);
+}
+
+// One browser per identity; returns KiB per identity
+async function measureBrowsers(chromiumPath, json, count) {
+  const browsers = [];
+  try {
+    for (let i = 0; i < count; i++) {
+      const browser = await launch(chromiumPath, [
+        `--fingerprint-config=${json}`,
+        `--fingerprint-seed=${i + 1}`,
+      ]);
+      browsers.push(browser);
+      await openIdentity(browser);
+    }
+    await new Promise(resolve => setTimeout(resolve, SETTLE_MS));
+    const total = browsers.reduce(
+        (sum, browser) => sum + treePssKiB(browser.process().pid), 0);
+    return { kib: total / count };
+  } finally {
+    await Promise.all(browsers.map(b => b.close().catch(() => {})));
+  }
+}
+
+// One browser, one BrowserContext per identity; returns KiB per identity
+async function measureContexts(chromiumPath, dir, profile, count) {
+  const socketPath = path.join(dir, `density-${count}.sock`);
+  const browser = await launch(chromiumPath, [
+    `--fingerprint-pool-socket=${socketPath}`,
+  ]);
+  try {
+    await waitForFile(socketPath);
+    let missing = 0;
+    for (let i = 0; i < count; i++) {
+      const context = await browser.createIncognitoBrowserContext();
+      await bind(socketPath, profile, BigInt(i + 1), context.id);
+      if (await openIdentity(context) !== HARDWARE_CONCURRENCY) {
+        missing++;
+      }
+    }
+    await new Promise(resolve => setTimeout(resolve, SETTLE_MS));
+    return { kib: treePssKiB(browser.process().pid) / count, missing };
+  } finally {
+    await browser.close();
+  }
+}
+
+async function runBenchmark(chromiumPath, counts) {
+  if (!fs.existsSync(chromiumPath)) {
+    log(`✗ Chromium not found at: ${chromiumPath}`, colors.red);
+    process.exit(1);
+  }
+  if (!fs.existsSync('/proc/self/smaps_rollup')) {
+    log('✗ Needs Linux 4.14+ for /proc/<pid>/smaps_rollup', colors.red);
+    process.exit(1);
+  }
+
+  const dir = fs.mkdtempSync(path.join(os.tmpdir(), 'context-density-'));
+  let failed = false;
+  try {
+    const { json, profile } = await writeProfiles(chromiumPath, dir);
+
+    log('ℹ PSS per identity, whole process tree', colors.blue);
+    log('identities  browsers(MiB)  contexts(MiB)  ratio');
+    for (const count of counts) {
+      const browsers = await measureBrowsers(chromiumPath, json, count);
+      const contexts = await measureContexts(chromiumPath, dir, profile, count);
+      log(`${String(count).padEnd(10)}  ` +
+          `${(browsers.kib / 1024).toFixed(1).padStart(13)}  ` +
+          `${(contexts.kib / 1024).toFixed(1).padStart(13)}  ` +
+          `${(browsers.kib / contexts.kib).toFixed(1).padStart(4)}x`);
+      if (contexts.missing > 0) {
+        log(`✗ ${count}: ${contexts.missing} contexts did not get their ` +
+            'identity', colors.red);
+        failed = true;
+      }
+    }
+  } finally {
+    fs.rmSync(dir, { recursive: true, force: true });
+  }
+
+  if (failed) {
+    log('\n✗ Per-context binding failed', colors.red);
+    process.exit(1);
+  }
+  log('\n✓ Every context carried its own identity', colors.green);
+}
+
+// Main
+const chromiumPath = process.argv[2] || '/usr/bin/chromium';
+const counts = (process.argv[3] || '1,10,50').split(',')
+    .map(n => parseInt(n, 10));
+runBenchmark(chromiumPath, counts).catch(error => {
+  log(`\n✗ Error running benchmark: ${error.message}`, colors.red);
+  console.error(error);
+  process.exit(1);
+});
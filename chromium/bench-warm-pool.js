@@ -0,0 +1,205 @@
+#!/usr/bin/env node
+
+/**
+ * Warm Browser Pool Benchmark
+ *
+ * Times a session's first navigation two ways: launching a browser with
+ * its fingerprint profile (cold), and binding the profile to an idle
+ * browser launched beforehand with --fingerprint-pool-socket (warm).
+ * Checks that every session sees the profile it was given. POSIX only.
+ *
+ * Usage:
+ *   node bench-warm-pool.js /path/to/chromium/chrome [sessions]
+ */
+
+const puppeteer = require('puppeteer-core');
+const fs = require('fs');
+const net = require('net');
+const os = require('os');
+const path = require('path');
+
+const URL = 'data:text/html,<title>first navigation</title>';
+
+// Not one of the values the browser picks when it has no profile, so a
+// session reporting it got its profile
+const HARDWARE_CONCURRENCY = 6;
+
+// FingerprintPoolBinding, see
+// content/browser/fingerprint/fingerprint_pool_binder.h. Host byte order;
+// every platform this runs on is little-endian.
+const BINDING_MAGIC = 0x42504455;  // "UDPB"
+const BINDING_VERSION = 2;
+const BINDING_HEADER_SIZE = 80;
+
+// Colors for output
+const colors = {
+  reset: '\x1b[0m',
+  green: '\x1b[32m',
+  red: '\x1b[31m',
+  blue: '\x1b[34m',
+};
+
+function log(message, color = colors.reset) {
+  console.log(`${color}${message}${colors.reset}`);
+}
+
+function launch(chromiumPath, args) {
+  return puppeteer.launch({
+    executablePath: chromiumPath,
+    headless: 'new',
+    args: ['--no-sandbox', '--disable-setuid-sandbox', ...args],
+  });
+}
+
+async function waitForFile(file, timeoutMs = 10000) {
+  const deadline = Date.now() + timeoutMs;
+  while (!fs.existsSync(file)) {
+    if (Date.now() > deadline) {
+      throw new Error(`${file} did not appear`);
+    }
+    await new Promise(resolve => setTimeout(resolve, 10));
+  }
+}
+
+// Has the browser turn a JSON profile into the binary one a binding carries
+async function writeProfiles(chromiumPath, dir) {
+  const json = path.join(dir, 'profile.json');
+  const binary = path.join(dir, 'profile.fpb');
+  fs.writeFileSync(json, JSON.stringify({
+    navigator: { hardwareConcurrency: HARDWARE_CONCURRENCY },
+  }));
+  const browser = await launch(chromiumPath, [
+    `--fingerprint-config=${json}`,
+    `--fingerprint-write-profile=${binary}`,
+  ]);
+  await browser.close();
+  await waitForFile(binary);
+  return { json, profile: fs.readFileSync(binary) };
+}
+
+function bind(socketPath, profile, seed) {
+  // An empty browser_context_id binds the whole browser
+  const header = Buffer.alloc(BINDING_HEADER_SIZE);
+  header.writeUInt32LE(BINDING_MAGIC, 0);
+  header.writeUInt32LE(BINDING_VERSION, 4);
+  header.writeBigUInt64LE(seed, 8);
+
+  return new Promise((resolve, reject) => {
+    let reply = '';
+    const socket = net.connect(socketPath, () => {
+      socket.write(Buffer.concat([header, profile]));
+    });
+    socket.on('data', data => {
+      reply += data;
+      if (reply.endsWith('\n')) {
+        socket.destroy();
+        if (reply === 'OK\n') {
+          resolve();
+        } else {
+          reject(new Error(`Binding rejected: ${reply.trim()}`));
+        }
+      }
+    });
+    socket.on('error', reject);
+  });
+}
+
+async function firstNavigation(browser) {
+  const page = await browser.newPage();
+  await page.goto(URL);
+  return page.evaluate(() => navigator.hardwareConcurrency);
+}
+
+async function coldSession(chromiumPath, json) {
+  const start = performance.now();
+  const browser = await launch(chromiumPath, [`--fingerprint-config=${json}`]);
+  try {
+    const cores = await firstNavigation(browser);
+    return { ms: performance.now() - start, cores };
+  } finally {
+    await browser.close();
+  }
+}
+
+async function warmSession(pooled, profile, seed) {
+  try {
+    const start = performance.now();
+    await bind(pooled.socketPath, profile, seed);
+    const cores = await firstNavigation(pooled.browser);
+    return { ms: performance.now() - start, cores };
+  } finally {
+    await pooled.browser.close();
+  }
+}
+
+function percentile(sorted, p) {
+  return sorted[Math.min(sorted.length - 1, Math.floor(sorted.length * p))];
+}
+
+async function runBenchmark(chromiumPath, sessions) {
+  if (!fs.existsSync(chromiumPath)) {
+    log(`✗ Chromium not found at: ${chromiumPath}`, colors.red);
+    process.exit(1);
+  }
+
+  const dir = fs.mkdtempSync(path.join(os.tmpdir(), 'warm-pool-'));
+  const results = { cold: [], warm: [] };
+  const pool = [];
+  let failed = false;
+  try {
+    const { json, profile } = await writeProfiles(chromiumPath, dir);
+
+    for (let i = 0; i < sessions; i++) {
+      results.cold.push(await coldSession(chromiumPath, json));
+    }
+
+    // The pool is filled before any session starts, as an orchestrator would
+    for (let i = 0; i < sessions; i++) {
+      const socketPath = path.join(dir, `pool-${i}.sock`);
+      const browser = await launch(chromiumPath, [
+        `--fingerprint-pool-socket=${socketPath}`,
+      ]);
+      pool.push({ browser, socketPath });
+      await waitForFile(socketPath);
+    }
+    for (let i = 0; i < sessions; i++) {
+      results.warm.push(await warmSession(pool[i], profile, BigInt(i + 1)));
+    }
+  } finally {
+    // Sessions close their browser; this catches the ones an error skipped
+    await Promise.all(pool.map(p => p.browser.close().catch(() => {})));
+    fs.rmSync(dir, { recursive: true, force: true });
+  }
+
+  log(`ℹ ${sessions} sessions per mode, time to first navigation`, colors.blue);
+  log('mode  median(ms)  p95(ms)');
+  const medians = {};
+  for (const mode of ['cold', 'warm']) {
+    const sorted = results[mode].map(r => r.ms).sort((a, b) => a - b);
+    medians[mode] = percentile(sorted, 0.5);
+    log(`${mode.padEnd(5)} ${medians[mode].toFixed(1).padStart(10)}  ` +
+        `${percentile(sorted, 0.95).toFixed(1).padStart(7)}`);
+    const wrong = results[mode].filter(r => r.cores !== HARDWARE_CONCURRENCY);
+    if (wrong.length > 0) {
+      log(`✗ ${mode}: ${wrong.length} sessions did not get their profile`,
+          colors.red);
+      failed = true;
+    }
+  }
+
+  if (failed) {
+    log('\n✗ Profile binding failed', colors.red);
+    process.exit(1);
+  }
+  log(`\n✓ Warm pool reaches the first navigation ` +
+      `${(medians.cold / medians.warm).toFixed(1)}x faster`, colors.green);
+}
+
+// Main
+const chromiumPath = process.argv[2] || '/usr/bin/chromium';
+const sessions = parseInt(process.argv[3] || '10', 10);
+runBenchmark(chromiumPath, sessions).catch(error => {
+  log(`\n✗ Error running benchmark: ${error.message}`, colors.red);
+  console.error(error);
+  process.exit(1);
+});
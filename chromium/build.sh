@@ -148,6 +148,7 @@ apply_patches() {
     PATCHES=(
         # Phase 1: Core integration layer
         "000-fingerprint-session-manager.patch"  # MUST BE FIRST - provides unified config
+        "026-fingerprint-noise-engine.patch"     # Shared noise engine used by the hooks
 
         # Phase 2: Unified patches that use FingerprintSessionManager
         "021-canvas-unified.patch"     # Canvas with unified config
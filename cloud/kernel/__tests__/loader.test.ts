@@ -2,7 +2,14 @@
  * Tests for eBPF Loader
  */
 
-import { eBPFLoader } from '../loader';
+import * as fs from 'fs';
+import * as os from 'os';
+import {
+  eBPFLoader,
+  encodeTCPProfile,
+  sumPerCPUCounters,
+  TCP_PROFILE_SIZE
+} from '../loader';
 import {
   TCPProfiles,
   JA3Profiles,
@@ -194,12 +201,13 @@ describe('eBPF Loader', () => {
   describe('Profile Updates', () => {
     it('should format TCP profile for BPF map', async () => {
       const profile = TCPProfiles['linux-chrome'];
-      const pid = process.pid;
+      const cgroupPath = await loader.getCgroupPathForPid(process.pid)
+        .catch(() => '/sys/fs/cgroup');
 
       // This would require actual BPF maps to be loaded
       // Testing the interface only
       try {
-        await loader.updateTCPProfile(pid, profile);
+        await loader.updateTCPProfile(cgroupPath, profile);
       } catch (error) {
         // Expected to fail if eBPF is not loaded
         expect(error.message).toBeDefined();
@@ -208,10 +216,11 @@ describe('eBPF Loader', () => {
 
     it('should format JA3 profile for BPF map', async () => {
       const profile = JA3Profiles['chrome-120-windows'];
-      const pid = process.pid;
+      const cgroupPath = await loader.getCgroupPathForPid(process.pid)
+        .catch(() => '/sys/fs/cgroup');
 
       try {
-        await loader.updateJA3Profile(pid, profile);
+        await loader.updateJA3Profile(cgroupPath, profile);
       } catch (error) {
         // Expected to fail if eBPF is not loaded
         expect(error.message).toBeDefined();
@@ -219,6 +228,72 @@ describe('eBPF Loader', () => {
     });
   });
 
+  describe('TCP Profile Layout', () => {
+    it('should match struct tcp_profile offsets', () => {
+      const buffer = encodeTCPProfile({
+        ...TCPProfiles['linux-chrome'],
+        initialCongestionWindow: 32,
+        sndCwndClamp: 200,
+        congestionControl: 'bbr'
+      });
+
+      expect(buffer.length).toBe(TCP_PROFILE_SIZE);
+      expect(buffer.readUInt32LE(12)).toBe(32);
+      expect(buffer.readUInt32LE(20)).toBe(200);
+      expect(buffer.toString('utf8', 24, 27)).toBe('bbr');
+      expect(buffer[27]).toBe(0);
+    });
+
+    it('should place latency knobs after the congestion name', () => {
+      const buffer = encodeTCPProfile({
+        ...TCPProfiles['linux-chrome'],
+        rtoMinUs: 50000,
+        delackMaxUs: 5000,
+        notsentLowat: 16384
+      });
+
+      expect(buffer.readUInt32LE(40)).toBe(50000);
+      expect(buffer.readUInt32LE(44)).toBe(5000);
+      expect(buffer.readUInt32LE(48)).toBe(16384);
+    });
+
+    it('should place buffer and pacing limits last', () => {
+      const buffer = encodeTCPProfile({
+        ...TCPProfiles['linux-chrome'],
+        sndBuf: 262144,
+        rcvBuf: 524288,
+        maxPacingRate: 1250000
+      });
+
+      expect(buffer.readUInt32LE(52)).toBe(262144);
+      expect(buffer.readUInt32LE(56)).toBe(524288);
+      expect(buffer.readUInt32LE(60)).toBe(1250000);
+    });
+
+    it('should leave congestion control unset by default', () => {
+      const buffer = encodeTCPProfile(TCPProfiles['linux-chrome']);
+
+      expect(buffer.readUInt32LE(20)).toBe(0);
+      expect(buffer[24]).toBe(0);
+    });
+
+    it('should reject congestion control names the kernel would truncate', () => {
+      expect(() => encodeTCPProfile({
+        ...TCPProfiles['linux-chrome'],
+        congestionControl: 'x'.repeat(16)
+      })).toThrow();
+    });
+  });
+
+  describe('Cgroup IDs', () => {
+    it('should key profiles by the cgroup directory inode', async () => {
+      const dir = os.tmpdir();
+      const { ino } = fs.statSync(dir, { bigint: true });
+
+      expect(await loader.getCgroupId(dir)).toBe(ino);
+    });
+  });
+
   describe('Statistics', () => {
     it('should get statistics from loaded program', async () => {
       try {
@@ -233,6 +308,54 @@ describe('eBPF Loader', () => {
         expect(error).toBeDefined();
       }
     });
+
+    it('should sum raw per-CPU counters', () => {
+      const u64 = (n: number) =>
+        [n, 0, 0, 0, 0, 0, 0, 0].map(b => `0x${b.toString(16).padStart(2, '0')}`);
+      const dump = [{
+        key: ['0x00', '0x00', '0x00', '0x00'],
+        values: [
+          { cpu: 0, value: [...u64(3), ...u64(10), ...u64(1)] },
+          { cpu: 1, value: [...u64(4), ...u64(20), ...u64(0)] }
+        ]
+      }];
+
+      expect(sumPerCPUCounters(dump)).toEqual([7, 30, 1]);
+    });
+
+    it('should sum BTF-formatted per-CPU counters', () => {
+      const dump = [{
+        key: ['0x00', '0x00', '0x00', '0x00'],
+        values: [],
+        formatted: {
+          key: 0,
+          values: [
+            { cpu: 0, value: { connections_modified: 2, packets_processed: 5, errors: 0 } },
+            { cpu: 1, value: { connections_modified: 1, packets_processed: 6, errors: 2 } }
+          ]
+        }
+      }];
+
+      expect(sumPerCPUCounters(dump)).toEqual([3, 11, 2]);
+    });
+
+    it('should sum a per-CPU map lookup', () => {
+      const u64 = (n: number) =>
+        [n, 0, 0, 0, 0, 0, 0, 0].map(b => `0x${b.toString(16).padStart(2, '0')}`);
+      const lookup = {
+        key: u64(42),
+        values: [
+          { cpu: 0, value: [...u64(100), ...u64(200)] },
+          { cpu: 1, value: [...u64(50), ...u64(0)] }
+        ]
+      };
+
+      expect(sumPerCPUCounters([lookup])).toEqual([150, 200]);
+    });
+
+    it('should return no counters for an empty dump', () => {
+      expect(sumPerCPUCounters([])).toEqual([]);
+    });
   });
 
   describe('Integration', () => {
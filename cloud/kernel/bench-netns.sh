@@ -0,0 +1,175 @@
+#!/bin/bash
+# TCP Profile Tuning Benchmark
+#
+# Times page fetches across a veth pair with proxy-like latency, with the
+# tcp_fingerprint profile's congestion tuning off and on. Two network
+# namespaces stand in for browser and proxy; netem adds the round trip.
+# Both ends run in one cgroup so the profile's initial window also applies to
+# the server's response flights, which is where it saves round trips.
+#
+# Usage:
+#   sudo ./bench-netns.sh [rtt_ms] [page_kib] [fetches] [iw] [congestion]
+#
+# Defaults: 150 ms RTT, 512 KiB page, 20 fetches, IW 32, bbr.
+# Needs root, clang, bpftool, iproute2, curl, python3 and cgroup v2.
+
+set -e
+
+RTT_MS="${1:-150}"
+PAGE_KIB="${2:-512}"
+FETCHES="${3:-20}"
+IW="${4:-32}"
+CONGESTION="${5:-bbr}"
+
+SCRIPT_DIR="$(cd "$(dirname "$0")" && pwd)"
+NAME="tcpbench$$"
+CGROUP="/sys/fs/cgroup/$NAME"
+PIN="/sys/fs/bpf/$NAME"
+WORK="$(mktemp -d)"
+SERVER_IP="10.200.0.1"
+CLIENT_IP="10.200.0.2"
+PORT=8080
+
+# Colors for output
+RED='\033[0;31m'
+GREEN='\033[0;32m'
+BLUE='\033[0;34m'
+NC='\033[0m' # No Color
+
+print_success() {
+    echo -e "${GREEN}✓ $1${NC}"
+}
+
+print_error() {
+    echo -e "${RED}✗ $1${NC}"
+}
+
+print_info() {
+    echo -e "${BLUE}ℹ $1${NC}"
+}
+
+cleanup() {
+    [ -n "$SERVER_PID" ] && kill "$SERVER_PID" 2>/dev/null || true
+    bpftool cgroup detach "$CGROUP" sock_ops pinned "$PIN/prog" 2>/dev/null || true
+    rm -rf "$PIN"
+    rmdir "$CGROUP" 2>/dev/null || true
+    ip netns del "${NAME}s" 2>/dev/null || true
+    ip netns del "${NAME}c" 2>/dev/null || true
+    rm -rf "$WORK"
+}
+trap cleanup EXIT
+
+# Little-endian hex bytes of $1, $2 bytes wide
+le() {
+    local value=$1 width=$2 out=""
+    for ((i = 0; i < width; i++)); do
+        out+="$(printf '%02x ' $(( (value >> (8 * i)) & 0xff )))"
+    done
+    echo "$out"
+}
+
+# struct tcp_profile: everything left at the kernel default except the
+# congestion window and algorithm, so the run isolates those two. Window
+# and TTL are set as encodeTCPProfile() always sets them, so the run also
+# goes through the SYN options every loaded profile carries.
+profile_hex() {
+    local iw=$1 congestion=$2 out
+    out="$(le 65535 2)$(le 64 1)$(le 0 1)$(le 0 2)$(le 0 4)$(le 0 2)"
+    out+="$(le "$iw" 4)$(le 0 4)$(le 0 4)"
+    for ((i = 0; i < 16; i++)); do
+        if [ "$i" -lt "${#congestion}" ]; then
+            out+="$(printf '%02x ' "'${congestion:$i:1}")"
+        else
+            out+="00 "
+        fi
+    done
+    out+="$(le 0 4)$(le 0 4)$(le 0 4)$(le 0 4)$(le 0 4)$(le 0 4)"
+    echo "$out"
+}
+
+# Runs a command as a member of the benchmark cgroup in namespace $1
+in_cgroup() {
+    local ns=$1
+    shift
+    ip netns exec "$ns" sh -c 'echo $$ > "$0/cgroup.procs" && exec "$@"' \
+        "$CGROUP" "$@"
+}
+
+# Median page-fetch time in milliseconds
+fetch_median_ms() {
+    for ((n = 0; n < FETCHES; n++)); do
+        # A fresh connection each time, so every fetch pays slow start
+        in_cgroup "${NAME}c" curl -s -o /dev/null -w '%{time_total}\n' \
+            "http://$SERVER_IP:$PORT/page.bin"
+    done | sort -n | awk '{ t[NR] = $1 } END { printf "%.1f", t[int((NR + 1) / 2)] * 1000 }'
+}
+
+if [ "$(id -u)" -ne 0 ]; then
+    print_error "Must run as root"
+    exit 1
+fi
+for tool in clang bpftool ip curl python3; do
+    if ! command -v "$tool" >/dev/null; then
+        print_error "$tool not found"
+        exit 1
+    fi
+done
+if ! grep -qw "$CONGESTION" /proc/sys/net/ipv4/tcp_available_congestion_control; then
+    modprobe "tcp_$CONGESTION" 2>/dev/null || {
+        print_error "Congestion control $CONGESTION not available"
+        exit 1
+    }
+fi
+
+# Network: two namespaces over a veth pair, half the RTT on each side
+ip netns add "${NAME}s"
+ip netns add "${NAME}c"
+ip link add "${NAME}a" type veth peer name "${NAME}b"
+ip link set "${NAME}a" netns "${NAME}s"
+ip link set "${NAME}b" netns "${NAME}c"
+ip -n "${NAME}s" addr add "$SERVER_IP/24" dev "${NAME}a"
+ip -n "${NAME}c" addr add "$CLIENT_IP/24" dev "${NAME}b"
+for side in "s ${NAME}a" "c ${NAME}b"; do
+    set -- $side
+    ip -n "${NAME}$1" link set "$2" up
+    ip -n "${NAME}$1" link set lo up
+    ip netns exec "${NAME}$1" tc qdisc add dev "$2" root netem \
+        delay "$((RTT_MS / 2))ms"
+done
+
+# Program, attached to a cgroup holding both ends
+mkdir -p "$CGROUP" "$PIN"
+clang -O2 -g -target bpf -c "$SCRIPT_DIR/ebpf/tcp_fingerprint.c" \
+    -o "$WORK/tcp_fingerprint.o"
+bpftool prog load "$WORK/tcp_fingerprint.o" "$PIN/prog" type sockops \
+    pinmaps "$PIN"
+bpftool cgroup attach "$CGROUP" sock_ops pinned "$PIN/prog"
+CGROUP_KEY="$(le "$(stat -c %i "$CGROUP")" 8)"
+
+head -c "$((PAGE_KIB * 1024))" /dev/urandom > "$WORK/page.bin"
+in_cgroup "${NAME}s" python3 -m http.server "$PORT" --bind "$SERVER_IP" \
+    --directory "$WORK" >/dev/null 2>&1 &
+SERVER_PID=$!
+sleep 1
+
+print_info "RTT ${RTT_MS} ms, ${PAGE_KIB} KiB page, median of ${FETCHES} fetches"
+
+# Off: no profile for the cgroup, so sockets keep the host defaults
+OFF_MS="$(fetch_median_ms)"
+echo "  tuning off: ${OFF_MS} ms"
+
+# The listener resolves its profile when it starts listening, so restart
+# the server after installing one
+bpftool map update pinned "$PIN/tcp_profiles" key hex $CGROUP_KEY \
+    value hex $(profile_hex "$IW" "$CONGESTION")
+kill "$SERVER_PID"
+wait "$SERVER_PID" 2>/dev/null || true
+in_cgroup "${NAME}s" python3 -m http.server "$PORT" --bind "$SERVER_IP" \
+    --directory "$WORK" >/dev/null 2>&1 &
+SERVER_PID=$!
+sleep 1
+
+ON_MS="$(fetch_median_ms)"
+echo "  tuning on (IW $IW, $CONGESTION): ${ON_MS} ms"
+
+print_success "Speedup: $(awk -v off="$OFF_MS" -v on="$ON_MS" 'BEGIN { printf "%.2fx", off / on }')"
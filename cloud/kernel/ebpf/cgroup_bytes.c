@@ -0,0 +1,70 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * Per-cgroup byte counters using eBPF
+ *
+ * Counts the bytes each cgroup's sockets send and receive, IP headers
+ * included, so the orchestrator can watch each browser instance's share of
+ * the NIC. Kept out of tcp_fingerprint.c: these are cgroup_skb programs, and
+ * a sockops object is loaded with every program forced to sockops.
+ *
+ * Attach point: BPF_CGROUP_INET_EGRESS and BPF_CGROUP_INET_INGRESS
+ */
+
+#include <linux/bpf.h>
+#include <bpf/bpf_helpers.h>
+
+/* Bytes each cgroup sent and received, for the orchestrator to watch */
+struct cgroup_bytes {
+    __u64 tx_bytes;
+    __u64 rx_bytes;
+};
+
+/*
+ * Keyed by cgroup v2 ID. LRU, so cgroups of browsers that have exited age
+ * out on their own. Per-CPU like the statistics maps; readers sum the copies.
+ */
+struct {
+    __uint(type, BPF_MAP_TYPE_LRU_PERCPU_HASH);
+    __type(key, __u64);
+    __type(value, struct cgroup_bytes);
+    __uint(max_entries, 4096);
+} cgroup_bytes SEC(".maps");
+
+/* Add |skb| to its socket's cgroup's byte counters */
+static __always_inline void count_bytes(struct __sk_buff *skb, __u8 egress)
+{
+    __u64 cgroup_id = bpf_skb_cgroup_id(skb);
+    struct cgroup_bytes *bytes;
+
+    bytes = bpf_map_lookup_elem(&cgroup_bytes, &cgroup_id);
+    if (!bytes) {
+        struct cgroup_bytes zero = {};
+
+        bpf_map_update_elem(&cgroup_bytes, &cgroup_id, &zero, BPF_NOEXIST);
+        bytes = bpf_map_lookup_elem(&cgroup_bytes, &cgroup_id);
+        if (!bytes)
+            return;
+    }
+
+    if (egress)
+        bytes->tx_bytes += skb->len;
+    else
+        bytes->rx_bytes += skb->len;
+}
+
+SEC("cgroup_skb/egress")
+int cgroup_count_egress(struct __sk_buff *skb)
+{
+    count_bytes(skb, 1);
+    return 1;  /* Allow */
+}
+
+SEC("cgroup_skb/ingress")
+int cgroup_count_ingress(struct __sk_buff *skb)
+{
+    count_bytes(skb, 0);
+    return 1;  /* Allow */
+}
+
+/* License required for GPL-only BPF helpers */
+char _license[] SEC("license") = "GPL";
@@ -4,14 +4,18 @@
  *
  * This eBPF program modifies TCP/IP stack parameters to spoof network
  * fingerprints. It can modify:
- * - TCP window size
- * - TTL (Time To Live)
- * - TCP options
+ * - TCP window clamp
  * - MSS (Maximum Segment Size)
- * - Window scale
- * - SACK (Selective Acknowledgment)
+ * - TCP_NODELAY
+ * - Congestion control, initial and clamped congestion window
+ * - Minimum RTO, delayed ACK ceiling and unsent-data low-water mark
+ * - Socket buffer sizes and egress pacing rate
  *
  * Attach point: BPF_CGROUP_SOCK_OPS
+ *
+ * Profiles are keyed by cgroup ID, one cgroup per browser instance, so they
+ * follow every process the browser spawns. A socket resolves its profile
+ * once, when it connects or listens, and keeps it in socket-local storage.
  */
 
 #include <linux/bpf.h>
@@ -24,26 +28,46 @@
 /* TCP Profile structure */
 struct tcp_profile {
     __u16 window_size;        /* Initial window size */
-    __u8 ttl;                  /* Time to live */
+    __u8 ttl;                  /* Time to live, not applied */
     __u16 mss;                 /* Maximum segment size */
     __u8 window_scale;         /* Window scale factor (0-14) */
     __u8 sack_permitted;       /* SACK permitted flag */
     __u8 timestamps;           /* TCP timestamps enabled */
     __u8 no_delay;             /* TCP_NODELAY (Nagle's algorithm) */
     __u32 initial_congestion_window; /* Initial cwnd */
-    __u8 ecn;                  /* ECN support */
-    __u8 fast_open;            /* TCP Fast Open */
+    __u8 ecn;                  /* ECN support, not applied */
+    __u8 fast_open;            /* TCP Fast Open, see set_timers() */
     __u8 padding[2];           /* Padding for alignment */
+    __u32 sndcwnd_clamp;       /* Congestion window cap, 0 for none */
+    char congestion[16];       /* TCP_CONGESTION name, empty for default */
+    __u32 rto_min_us;          /* Minimum retransmit timeout, 0 for default */
+    __u32 delack_max_us;       /* Delayed ACK ceiling, 0 for default */
+    __u32 notsent_lowat;       /* TCP_NOTSENT_LOWAT bytes, 0 for default */
+    __u32 sndbuf;              /* SO_SNDBUF bytes, 0 to autotune */
+    __u32 rcvbuf;              /* SO_RCVBUF bytes, 0 to autotune */
+    __u32 max_pacing_rate;     /* Bytes per second, 0 for unpaced */
 };
 
-/* Hash map to store TCP profiles per process/connection */
+/* Hash map to store TCP profiles per browser cgroup */
 struct {
     __uint(type, BPF_MAP_TYPE_HASH);
-    __type(key, __u32);        /* PID or connection ID */
+    __type(key, __u64);        /* cgroup v2 ID */
     __type(value, struct tcp_profile);
     __uint(max_entries, 1024);
 } tcp_profiles SEC(".maps");
 
+/*
+ * The profile a socket resolved, so later callbacks cost one socket-local
+ * load. BPF_F_CLONE copies a listener's entry to the sockets it accepts,
+ * whose callbacks run in softirq where the current cgroup is meaningless.
+ */
+struct {
+    __uint(type, BPF_MAP_TYPE_SK_STORAGE);
+    __uint(map_flags, BPF_F_NO_PREALLOC | BPF_F_CLONE);
+    __type(key, int);
+    __type(value, struct tcp_profile);
+} tcp_profile_cache SEC(".maps");
+
 /* Statistics map */
 struct tcp_stats {
     __u64 connections_modified;
@@ -51,28 +75,216 @@ struct tcp_stats {
     __u64 errors;
 };
 
+/*
+ * One copy per CPU, so cores never share a cacheline. Programs run with
+ * migration disabled, so plain increments suffice; a softirq interrupting
+ * a process-context run on the same CPU can lose a count, which is fine for
+ * statistics. Readers sum the copies.
+ */
 struct {
-    __uint(type, BPF_MAP_TYPE_ARRAY);
+    __uint(type, BPF_MAP_TYPE_PERCPU_ARRAY);
     __type(key, __u32);
     __type(value, struct tcp_stats);
     __uint(max_entries, 1);
 } stats SEC(".maps");
 
-/* Helper function to update statistics */
-static __always_inline void update_stats(__u8 error)
+/* Helper function to update statistics; |st| may be NULL */
+static __always_inline void update_stats(struct tcp_stats *st, __u8 error)
 {
-    __u32 key = 0;
-    struct tcp_stats *st;
-
-    st = bpf_map_lookup_elem(&stats, &key);
     if (!st)
         return;
 
     if (error) {
-        __sync_fetch_and_add(&st->errors, 1);
+        st->errors++;
     } else {
-        __sync_fetch_and_add(&st->connections_modified, 1);
+        st->connections_modified++;
+    }
+}
+
+/*
+ * Look up the calling task's cgroup profile and cache it on the socket.
+ * Only valid from callbacks that run in the task's context: connect and
+ * listen.
+ */
+static __always_inline struct tcp_profile *
+cache_profile(struct bpf_sock_ops *skops)
+{
+    struct tcp_profile *profile;
+    struct bpf_sock *sk = skops->sk;
+    __u64 cgroup_id;
+
+    if (!sk)
+        return 0;
+
+    cgroup_id = bpf_get_current_cgroup_id();
+    profile = bpf_map_lookup_elem(&tcp_profiles, &cgroup_id);
+    if (!profile)
+        return 0;
+
+    return bpf_sk_storage_get(&tcp_profile_cache, sk, profile,
+                              BPF_SK_STORAGE_GET_F_CREATE);
+}
+
+/* The profile cached on this socket, if any */
+static __always_inline struct tcp_profile *
+cached_profile(struct bpf_sock_ops *skops)
+{
+    struct bpf_sock *sk = skops->sk;
+
+    if (!sk)
+        return 0;
+
+    return bpf_sk_storage_get(&tcp_profile_cache, sk, 0, 0);
+}
+
+/*
+ * The SYN-shaping options. bpf_setsockopt() takes them as an int, and has
+ * no TTL, hop limit or ECN option, so those profile fields are not applied.
+ * Every option is tried; nonzero if any failed.
+ */
+static __always_inline int set_syn_options(struct bpf_sock_ops *skops,
+                                           struct tcp_profile *profile)
+{
+    int value;
+    int ret = 0;
+
+    if (profile->window_size > 0) {
+        value = profile->window_size;
+        if (bpf_setsockopt(skops, SOL_TCP, TCP_WINDOW_CLAMP,
+                           &value, sizeof(value)) != 0)
+            ret = -1;
+    }
+
+    if (profile->mss > 0) {
+        value = profile->mss;
+        if (bpf_setsockopt(skops, SOL_TCP, TCP_MAXSEG,
+                           &value, sizeof(value)) != 0)
+            ret = -1;
+    }
+
+    if (profile->no_delay) {
+        value = 1;
+        if (bpf_setsockopt(skops, SOL_TCP, TCP_NODELAY,
+                           &value, sizeof(value)) != 0)
+            ret = -1;
+    }
+
+    return ret;
+}
+
+/* Switch to the profile's congestion control; 0 if it has none */
+static __always_inline int set_congestion(struct bpf_sock_ops *skops,
+                                          struct tcp_profile *profile)
+{
+    if (!profile->congestion[0])
+        return 0;
+
+    return bpf_setsockopt(skops, SOL_TCP, TCP_CONGESTION,
+                          profile->congestion, sizeof(profile->congestion));
+}
+
+/*
+ * Initial and clamped congestion window. The kernel sets the initial window
+ * when the handshake completes, so these only stick from the established
+ * callbacks, before any data is sent.
+ */
+static __always_inline int set_cwnd(struct bpf_sock_ops *skops,
+                                    struct tcp_profile *profile)
+{
+    int ret;
+
+    if (profile->initial_congestion_window > 0) {
+        ret = bpf_setsockopt(skops, SOL_TCP, TCP_BPF_IW,
+                             &profile->initial_congestion_window,
+                             sizeof(profile->initial_congestion_window));
+        if (ret != 0)
+            return ret;
+    }
+
+    if (profile->sndcwnd_clamp > 0) {
+        ret = bpf_setsockopt(skops, SOL_TCP, TCP_BPF_SNDCWND_CLAMP,
+                             &profile->sndcwnd_clamp,
+                             sizeof(profile->sndcwnd_clamp));
+        if (ret != 0)
+            return ret;
+    }
+
+    return 0;
+}
+
+/*
+ * Per-socket replacements for the net.ipv4 timer sysctls. Set once the
+ * connection is established, when the kernel has finished initialising
+ * them. fast_open has no counterpart here: bpf_setsockopt() does not accept
+ * TCP_FASTOPEN or TCP_FASTOPEN_CONNECT, so TFO stays with the application
+ * and the namespace's net.ipv4.tcp_fastopen.
+ */
+static __always_inline int set_timers(struct bpf_sock_ops *skops,
+                                      struct tcp_profile *profile)
+{
+    int ret;
+
+    if (profile->rto_min_us > 0) {
+        ret = bpf_setsockopt(skops, SOL_TCP, TCP_BPF_RTO_MIN,
+                             &profile->rto_min_us,
+                             sizeof(profile->rto_min_us));
+        if (ret != 0)
+            return ret;
+    }
+
+    if (profile->delack_max_us > 0) {
+        ret = bpf_setsockopt(skops, SOL_TCP, TCP_BPF_DELACK_MAX,
+                             &profile->delack_max_us,
+                             sizeof(profile->delack_max_us));
+        if (ret != 0)
+            return ret;
+    }
+
+    if (profile->notsent_lowat > 0) {
+        ret = bpf_setsockopt(skops, SOL_TCP, TCP_NOTSENT_LOWAT,
+                             &profile->notsent_lowat,
+                             sizeof(profile->notsent_lowat));
+        if (ret != 0)
+            return ret;
+    }
+
+    return 0;
+}
+
+/*
+ * Bound the socket's share of the NIC. Set before the SYN, so the window
+ * scale advertised in it reflects the receive buffer; a listener's values
+ * carry over to the sockets it accepts. Fixed buffer sizes turn off the
+ * kernel's buffer autotuning for the socket.
+ */
+static __always_inline int set_limits(struct bpf_sock_ops *skops,
+                                      struct tcp_profile *profile)
+{
+    int ret;
+
+    if (profile->sndbuf > 0) {
+        ret = bpf_setsockopt(skops, SOL_SOCKET, SO_SNDBUF,
+                             &profile->sndbuf, sizeof(profile->sndbuf));
+        if (ret != 0)
+            return ret;
+    }
+
+    if (profile->rcvbuf > 0) {
+        ret = bpf_setsockopt(skops, SOL_SOCKET, SO_RCVBUF,
+                             &profile->rcvbuf, sizeof(profile->rcvbuf));
+        if (ret != 0)
+            return ret;
     }
+
+    if (profile->max_pacing_rate > 0) {
+        ret = bpf_setsockopt(skops, SOL_SOCKET, SO_MAX_PACING_RATE,
+                             &profile->max_pacing_rate,
+                             sizeof(profile->max_pacing_rate));
+        if (ret != 0)
+            return ret;
+    }
+
+    return 0;
 }
 
 /* Main sockops handler for TCP connection establishment */
@@ -80,94 +292,77 @@ SEC("sockops")
 int tcp_fingerprint_spoof(struct bpf_sock_ops *skops)
 {
     struct tcp_profile *profile;
-    __u32 pid;
-    int ret;
+    struct tcp_stats *st;
+    __u32 key = 0;
 
     /* Only handle TCP connections */
     if (skops->family != AF_INET && skops->family != AF_INET6)
         return 0;
 
+    /* This CPU's counters, looked up once per invocation */
+    st = bpf_map_lookup_elem(&stats, &key);
+
     /* Handle different socket operations */
     switch (skops->op) {
     case BPF_SOCK_OPS_TCP_CONNECT_CB:
-        /* Active connection (client) */
-        pid = bpf_get_current_pid_tgid() >> 32;
-        profile = bpf_map_lookup_elem(&tcp_profiles, &pid);
+        /* Active connection (client), in the connecting task's context */
+        profile = cache_profile(skops);
 
         if (!profile) {
-            return 0;  /* No profile for this process */
-        }
-
-        /* Modify TCP window size */
-        if (profile->window_size > 0) {
-            ret = bpf_setsockopt(skops, SOL_TCP, TCP_WINDOW_CLAMP,
-                               &profile->window_size, sizeof(profile->window_size));
-            if (ret != 0) {
-                update_stats(1);
-                return 0;
-            }
-        }
-
-        /* Modify TTL */
-        if (profile->ttl > 0) {
-            int level = (skops->family == AF_INET) ? SOL_IP : SOL_IPV6;
-            int optname = (skops->family == AF_INET) ? IP_TTL : IPV6_UNICAST_HOPS;
-
-            ret = bpf_setsockopt(skops, level, optname,
-                               &profile->ttl, sizeof(profile->ttl));
-            if (ret != 0) {
-                update_stats(1);
-                return 0;
-            }
+            return 0;  /* No profile for this cgroup */
         }
 
-        /* Modify MSS (Maximum Segment Size) */
-        if (profile->mss > 0) {
-            ret = bpf_setsockopt(skops, SOL_TCP, TCP_MAXSEG,
-                               &profile->mss, sizeof(profile->mss));
-            if (ret != 0) {
-                update_stats(1);
-                return 0;
-            }
+        /*
+         * Before the SYN, so the whole connection runs under them, and
+         * ahead of the fingerprint options so no rejection of those can
+         * cost the instance its share of the NIC
+         */
+        if (set_congestion(skops, profile) != 0 ||
+            set_limits(skops, profile) != 0) {
+            update_stats(st, 1);
+            return 0;
         }
 
-        /* Enable/disable TCP_NODELAY */
-        if (profile->no_delay) {
-            __u32 nodelay = 1;
-            ret = bpf_setsockopt(skops, SOL_TCP, TCP_NODELAY,
-                               &nodelay, sizeof(nodelay));
-            if (ret != 0) {
-                update_stats(1);
-            }
+        /* A rejected option is counted, but does not stop the others */
+        if (set_syn_options(skops, profile) != 0) {
+            update_stats(st, 1);
+            return 0;
         }
 
-        /* ECN support */
-        if (profile->ecn) {
-            ret = bpf_setsockopt(skops, SOL_TCP, TCP_ECN,
-                               &profile->ecn, sizeof(profile->ecn));
-        }
+        update_stats(st, 0);
+        break;
 
-        update_stats(0);
+    case BPF_SOCK_OPS_TCP_LISTEN_CB:
+        /* Cached here so accepted sockets inherit it */
+        profile = cache_profile(skops);
+        if (profile && set_limits(skops, profile) != 0)
+            update_stats(st, 1);
         break;
 
     case BPF_SOCK_OPS_PASSIVE_ESTABLISHED_CB:
         /* Passive connection (server) - can also be spoofed */
-        pid = bpf_get_current_pid_tgid() >> 32;
-        profile = bpf_map_lookup_elem(&tcp_profiles, &pid);
+        profile = cached_profile(skops);
 
-        if (profile && profile->window_size > 0) {
-            bpf_setsockopt(skops, SOL_TCP, TCP_WINDOW_CLAMP,
-                         &profile->window_size, sizeof(profile->window_size));
-        }
+        if (!profile)
+            break;
+
+        if (set_congestion(skops, profile) != 0 ||
+            set_syn_options(skops, profile) != 0 ||
+            set_cwnd(skops, profile) != 0 ||
+            set_timers(skops, profile) != 0)
+            update_stats(st, 1);
         break;
 
     case BPF_SOCK_OPS_ACTIVE_ESTABLISHED_CB:
         /* Connection fully established */
-        __u32 key = 0;
-        struct tcp_stats *st = bpf_map_lookup_elem(&stats, &key);
         if (st) {
-            __sync_fetch_and_add(&st->packets_processed, 1);
+            st->packets_processed++;
         }
+
+        profile = cached_profile(skops);
+        if (profile && (set_cwnd(skops, profile) != 0 ||
+                        set_timers(skops, profile) != 0))
+            update_stats(st, 1);
         break;
 
     default:
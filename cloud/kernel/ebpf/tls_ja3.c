@@ -12,6 +12,10 @@
  * - Elliptic Curve Formats
  *
  * Attach point: BPF_PROG_TYPE_SOCKET_FILTER or TC (Traffic Control)
+ *
+ * Profiles are keyed by cgroup ID, one cgroup per browser instance, so they
+ * apply to the browser's network service process as well as the one that
+ * registered them.
  */
 
 #include <linux/bpf.h>
@@ -50,10 +54,10 @@ struct ja3_profile {
     __u8 padding[3];            /* Padding for alignment */
 };
 
-/* Hash map to store JA3 profiles per process */
+/* Hash map to store JA3 profiles per browser cgroup */
 struct {
     __uint(type, BPF_MAP_TYPE_HASH);
-    __type(key, __u32);         /* PID */
+    __type(key, __u64);         /* cgroup v2 ID */
     __type(value, struct ja3_profile);
     __uint(max_entries, 256);
 } ja3_profiles SEC(".maps");
@@ -66,8 +70,9 @@ struct ja3_stats {
     __u64 packets_passed;
 };
 
+/* Per-CPU, so egress on many cores never contends on one cacheline */
 struct {
-    __uint(type, BPF_MAP_TYPE_ARRAY);
+    __uint(type, BPF_MAP_TYPE_PERCPU_ARRAY);
     __type(key, __u32);
     __type(value, struct ja3_stats);
     __uint(max_entries, 1);
@@ -86,23 +91,24 @@ struct tls_handshake {
     __u8 length[3];  /* 24-bit length */
 } __attribute__((packed));
 
-/* Helper to update statistics */
-static __always_inline void update_ja3_stats(__u64 *counter)
+/*
+ * This CPU's statistics. Programs look them up once per invocation and bump
+ * counters with plain increments: they run with migration disabled, and a
+ * count lost to a softirq on the same CPU is acceptable for statistics.
+ */
+static __always_inline struct ja3_stats *get_ja3_stats(void)
 {
     __u32 key = 0;
-    struct ja3_stats *stats;
 
-    stats = bpf_map_lookup_elem(&ja3_stats_map, &key);
-    if (stats) {
-        __sync_fetch_and_add(counter, 1);
-    }
+    return bpf_map_lookup_elem(&ja3_stats_map, &key);
 }
 
 /* Parse TLS Client Hello and check if modification is needed */
 static __always_inline int parse_tls_client_hello(
     void *data,
     void *data_end,
-    struct ja3_profile *profile)
+    struct ja3_profile *profile,
+    struct ja3_stats *stats)
 {
     struct ethhdr *eth = data;
     struct iphdr *ip;
@@ -155,7 +161,8 @@ static __always_inline int parse_tls_client_hello(
     if (handshake->msg_type != TLS_CLIENT_HELLO)
         return 0;
 
-    update_ja3_stats(&((struct ja3_stats *)bpf_map_lookup_elem(&ja3_stats_map, &(__u32){0}))->client_hello_seen);
+    if (stats)
+        stats->client_hello_seen++;
 
     /*
      * NOTE: Modifying TLS Client Hello in flight is complex and risky.
@@ -174,26 +181,21 @@ static __always_inline int parse_tls_client_hello(
     return 1;  /* Packet matches, but we're just observing */
 }
 
-/* Socket filter program */
+/*
+ * Socket filter program. Its owner attaches it to one socket, and socket
+ * filters have no helper that names a cgroup, so there is no profile to
+ * resolve and no enabled flag to check: attaching it is the opt-in. It only
+ * observes, so it counts Client Hellos seen, never modified.
+ */
 SEC("socket")
 int ja3_socket_filter(struct __sk_buff *skb)
 {
-    __u32 pid = bpf_get_current_pid_tgid() >> 32;
-    struct ja3_profile *profile;
+    struct ja3_stats *stats = get_ja3_stats();
     void *data = (void *)(long)skb->data;
     void *data_end = (void *)(long)skb->data_end;
 
-    /* Lookup JA3 profile for this process */
-    profile = bpf_map_lookup_elem(&ja3_profiles, &pid);
-    if (!profile || !profile->enabled)
-        return 0;  /* Pass through */
-
-    /* Parse and potentially modify TLS Client Hello */
-    if (parse_tls_client_hello(data, data_end, profile)) {
-        /* Client Hello detected - in production, this would trigger
-         * a userspace handler to properly modify the TLS handshake */
-        update_ja3_stats(&((struct ja3_stats *)bpf_map_lookup_elem(&ja3_stats_map, &(__u32){0}))->client_hello_modified);
-    }
+    /* Counts client_hello_seen; modification belongs to userspace */
+    parse_tls_client_hello(data, data_end, 0, stats);
 
     /* Pass packet through */
     return 0;
@@ -203,17 +205,21 @@ int ja3_socket_filter(struct __sk_buff *skb)
 SEC("classifier/egress")
 int ja3_tc_egress(struct __sk_buff *skb)
 {
-    __u32 pid = bpf_get_current_pid_tgid() >> 32;
+    /*
+     * Egress may run in softirq, so key by the sending socket's cgroup
+     * rather than the current task's. TC cannot read socket storage.
+     */
+    __u64 cgroup_id = bpf_skb_cgroup_id(skb);
     struct ja3_profile *profile;
     void *data = (void *)(long)skb->data;
     void *data_end = (void *)(long)skb->data_end;
 
-    profile = bpf_map_lookup_elem(&ja3_profiles, &pid);
+    profile = bpf_map_lookup_elem(&ja3_profiles, &cgroup_id);
     if (!profile || !profile->enabled)
         return TC_ACT_OK;
 
     /* Detect TLS Client Hello */
-    if (parse_tls_client_hello(data, data_end, profile)) {
+    if (parse_tls_client_hello(data, data_end, profile, get_ja3_stats())) {
         /*
          * In a full implementation, we would:
          * 1. Clone the packet
@@ -236,7 +242,7 @@ int ja3_tc_egress(struct __sk_buff *skb)
 SEC("sockops")
 int ja3_sockops(struct bpf_sock_ops *skops)
 {
-    __u32 pid;
+    __u64 cgroup_id;
     struct ja3_profile *profile;
 
     /* Only handle TCP connections to port 443 (HTTPS) */
@@ -248,15 +254,22 @@ int ja3_sockops(struct bpf_sock_ops *skops)
 
     switch (skops->op) {
     case BPF_SOCK_OPS_TCP_CONNECT_CB:
-        /* Connection to HTTPS server */
-        pid = bpf_get_current_pid_tgid() >> 32;
-        profile = bpf_map_lookup_elem(&ja3_profiles, &pid);
+        /*
+         * Connection to HTTPS server, in the connecting task's context.
+         * This is the only callback that needs the profile, so it is not
+         * worth caching on the socket.
+         */
+        cgroup_id = bpf_get_current_cgroup_id();
+        profile = bpf_map_lookup_elem(&ja3_profiles, &cgroup_id);
 
         if (profile && profile->enabled) {
+            struct ja3_stats *stats = get_ja3_stats();
+
             /* Mark this connection for JA3 spoofing
              * The actual TLS modification should happen at the
              * application layer (browser/OpenSSL) */
-            update_ja3_stats(&((struct ja3_stats *)bpf_map_lookup_elem(&ja3_stats_map, &(__u32){0}))->packets_passed);
+            if (stats)
+                stats->packets_passed++;
         }
         break;
 
@@ -296,5 +309,5 @@ char _license[] SEC("license") = "GPL";
  * - Detection of TLS Client Hello packets
  * - Monitoring and statistics
  * - Triggering userspace handlers
- * - Process-based profile management
+ * - Cgroup-based profile management
  */
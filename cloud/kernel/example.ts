@@ -271,15 +271,16 @@ export async function example7_SpecificProcess() {
 
     console.log(`Found Chrome process: PID ${chromePid}`);
 
-    // Load profile for this specific PID
+    // Profiles follow the cgroup, so Chrome's network service is covered too
+    const cgroupPath = await ebpfLoader.getCgroupPathForPid(parseInt(chromePid));
     const profile = TCPProfiles['linux-chrome'];
     if (!profile) {
       throw new Error('Profile not found');
     }
-    await ebpfLoader.loadTCPFingerprint(profile, parseInt(chromePid));
+    await ebpfLoader.loadTCPFingerprint(profile, cgroupPath);
 
-    console.log(`✓ TCP fingerprinting applied to PID ${chromePid}`);
-    console.log('\nNow all connections from this Chrome process will be spoofed!');
+    console.log(`✓ TCP fingerprinting applied to cgroup ${cgroupPath}`);
+    console.log('\nNow all connections from this Chrome instance will be spoofed!');
 
   } catch (error) {
     console.error('Error:', (error as Error).message);
@@ -29,6 +29,7 @@ export {
   TCPProfile,
   JA3Profile,
   eBPFStats,
+  CgroupByteStats,
   OSType,
   BrowserType,
   NetworkFingerprintConfig,
@@ -9,7 +9,7 @@ import { spawn, exec } from 'child_process';
 import { promises as fs } from 'fs';
 import { promisify } from 'util';
 import * as path from 'path';
-import { TCPProfile, JA3Profile, eBPFStats } from './types';
+import { TCPProfile, JA3Profile, eBPFStats, CgroupByteStats } from './types';
 
 const execAsync = promisify(exec);
 
@@ -20,6 +20,7 @@ export interface eBPFProgramInfo {
   loaded: boolean;
   attached: boolean;
   attachPoint?: string;
+  attachType?: string;
 }
 
 export interface CompileOptions {
@@ -36,6 +37,92 @@ export interface LoadOptions {
   cgroupPath?: string;    // Cgroup to attach to
 }
 
+/** sizeof(struct tcp_profile) in ebpf/tcp_fingerprint.c */
+export const TCP_PROFILE_SIZE = 64;
+
+/** bpffs directory holding the byte counter programs and their maps */
+const BYTE_COUNTERS_DIR = 'tcp_byte_counters';
+
+/** TCP_CA_NAME_MAX, including the terminating NUL */
+const TCP_CA_NAME_MAX = 16;
+
+/**
+ * Encode a profile as struct tcp_profile, with the C compiler's padding
+ */
+export function encodeTCPProfile(profile: TCPProfile): Buffer {
+  const buffer = Buffer.alloc(TCP_PROFILE_SIZE);
+
+  buffer.writeUInt16LE(profile.windowSize || 65535, 0);
+  buffer.writeUInt8(profile.ttl || 64, 2);
+  buffer.writeUInt16LE(profile.mss || 1460, 4);
+  buffer.writeUInt8(profile.windowScale || 8, 6);
+  buffer.writeUInt8(profile.sackPermitted ? 1 : 0, 7);
+  buffer.writeUInt8(profile.timestamps ? 1 : 0, 8);
+  buffer.writeUInt8(profile.noDelay ? 1 : 0, 9);
+  buffer.writeUInt32LE(profile.initialCongestionWindow || 10, 12);
+  buffer.writeUInt8(profile.ecn ? 1 : 0, 16);
+  buffer.writeUInt8(profile.fastOpen ? 1 : 0, 17);
+  buffer.writeUInt32LE(profile.sndCwndClamp || 0, 20);
+
+  const congestion = profile.congestionControl || '';
+  if (Buffer.byteLength(congestion) >= TCP_CA_NAME_MAX) {
+    throw new Error(`Congestion control name too long: ${congestion}`);
+  }
+  buffer.write(congestion, 24);
+
+  buffer.writeUInt32LE(profile.rtoMinUs || 0, 40);
+  buffer.writeUInt32LE(profile.delackMaxUs || 0, 44);
+  buffer.writeUInt32LE(profile.notsentLowat || 0, 48);
+  buffer.writeUInt32LE(profile.sndBuf || 0, 52);
+  buffer.writeUInt32LE(profile.rcvBuf || 0, 56);
+  buffer.writeUInt32LE(profile.maxPacingRate || 0, 60);
+
+  return buffer;
+}
+
+/**
+ * Sum the first entry of a per-CPU array map across CPUs
+ *
+ * Takes the output of `bpftool map dump -j` and returns the entry's __u64
+ * counters in struct order. Handles BTF-formatted values (field objects) and
+ * raw little-endian hex bytes, per-CPU `values` or a single `value`.
+ */
+export function sumPerCPUCounters(dump: unknown): number[] {
+  const entry: any = Array.isArray(dump) ? dump[0] : undefined;
+  if (!entry) {
+    return [];
+  }
+
+  const source = entry.formatted ?? entry;
+  const values: unknown[] = Array.isArray(source.values)
+    ? source.values.map((v: any) => v?.value)
+    : [source.value];
+
+  const totals: bigint[] = [];
+  for (const value of values) {
+    decodeCounters(value).forEach((counter, i) => {
+      totals[i] = (totals[i] ?? 0n) + counter;
+    });
+  }
+  return totals.map(Number);
+}
+
+function decodeCounters(value: unknown): bigint[] {
+  if (Array.isArray(value)) {
+    // Raw bytes, e.g. ["0x01", "0x00", ...]; eight per __u64
+    const bytes = Buffer.from(value.map(b => parseInt(String(b), 16)));
+    const counters: bigint[] = [];
+    for (let off = 0; off + 8 <= bytes.length; off += 8) {
+      counters.push(bytes.readBigUInt64LE(off));
+    }
+    return counters;
+  }
+  if (value && typeof value === 'object') {
+    return Object.values(value).map(v => BigInt(v as number | string));
+  }
+  return [];
+}
+
 export class eBPFLoader {
   private loadedPrograms: Map<string, eBPFProgramInfo> = new Map();
   private ebpfBasePath: string;
@@ -242,6 +329,7 @@ export class eBPFLoader {
 
       prog.attached = true;
       prog.attachPoint = cgroup;
+      prog.attachType = attachType;
 
       console.log(`✓ Attached ${programName} to ${cgroup}`);
     } catch (error) {
@@ -271,6 +359,7 @@ export class eBPFLoader {
 
       prog.attached = false;
       prog.attachPoint = undefined;
+      prog.attachType = undefined;
 
       console.log(`✓ Detached ${programName} from ${cgroup}`);
     } catch (error) {
@@ -279,51 +368,52 @@ export class eBPFLoader {
   }
 
   /**
-   * Update TCP profile in BPF map
+   * cgroup v2 ID of a cgroup directory: its kernfs inode number, as returned
+   * by bpf_get_current_cgroup_id()
+   */
+  async getCgroupId(cgroupPath: string): Promise<bigint> {
+    const stat = await fs.stat(cgroupPath, { bigint: true });
+    return stat.ino;
+  }
+
+  /**
+   * cgroup v2 directory a process belongs to
    */
-  async updateTCPProfile(pid: number, profile: TCPProfile): Promise<void> {
+  async getCgroupPathForPid(pid: number): Promise<string> {
+    const content = await fs.readFile(`/proc/${pid}/cgroup`, 'utf8');
+    const unified = content.split('\n').find(line => line.startsWith('0::'));
+    if (!unified) {
+      throw new Error(`PID ${pid} is not in a cgroup v2 hierarchy`);
+    }
+    return path.join(this.cgroupPath, unified.slice(3));
+  }
+
+  private async cgroupKeyHex(cgroupPath: string): Promise<string> {
+    const keyBuf = Buffer.alloc(8);
+    keyBuf.writeBigUInt64LE(await this.getCgroupId(cgroupPath), 0);
+    return keyBuf.toString('hex');
+  }
+
+  /**
+   * Update TCP profile in BPF map for every socket in a cgroup
+   */
+  async updateTCPProfile(cgroupPath: string, profile: TCPProfile): Promise<void> {
     const mapPath = path.join(this.bpfFsPath, 'tcp_profiles');
 
     // Create binary representation of profile
-    const buffer = Buffer.alloc(32);  // Size of struct tcp_profile
-    let offset = 0;
+    const buffer = encodeTCPProfile(profile);
 
-    buffer.writeUInt16LE(profile.windowSize || 65535, offset); offset += 2;
-    buffer.writeUInt8(profile.ttl || 64, offset); offset += 1;
-    offset += 1; // padding
-    buffer.writeUInt16LE(profile.mss || 1460, offset); offset += 2;
-    buffer.writeUInt8(profile.windowScale || 8, offset); offset += 1;
-    buffer.writeUInt8(profile.sackPermitted ? 1 : 0, offset); offset += 1;
-    buffer.writeUInt8(profile.timestamps ? 1 : 0, offset); offset += 1;
-    buffer.writeUInt8(profile.noDelay ? 1 : 0, offset); offset += 1;
-    buffer.writeUInt32LE(profile.initialCongestionWindow || 10, offset); offset += 4;
-    buffer.writeUInt8(profile.ecn ? 1 : 0, offset); offset += 1;
-    buffer.writeUInt8(profile.fastOpen ? 1 : 0, offset); offset += 1;
-
-    // Write to temporary file
-    const tmpFile = `/tmp/tcp_profile_${pid}`;
-    await fs.writeFile(tmpFile, buffer);
+    // Update map using bpftool
+    const key = await this.cgroupKeyHex(cgroupPath);
+    await execAsync(`bpftool map update pinned ${mapPath} key hex ${key} value hex ${buffer.toString('hex')}`);
 
-    try {
-      // Update map using bpftool
-      const keyBuf = Buffer.alloc(4);
-      keyBuf.writeUInt32LE(pid, 0);
-      await fs.writeFile(`${tmpFile}_key`, keyBuf);
-
-      await execAsync(`bpftool map update pinned ${mapPath} key hex ${keyBuf.toString('hex')} value hex ${buffer.toString('hex')}`);
-
-      console.log(`✓ Updated TCP profile for PID ${pid}`);
-    } finally {
-      // Cleanup
-      await fs.unlink(tmpFile).catch(() => {});
-      await fs.unlink(`${tmpFile}_key`).catch(() => {});
-    }
+    console.log(`✓ Updated TCP profile for cgroup ${cgroupPath}`);
   }
 
   /**
-   * Update JA3 profile in BPF map
+   * Update JA3 profile in BPF map for every socket in a cgroup
    */
-  async updateJA3Profile(pid: number, profile: JA3Profile): Promise<void> {
+  async updateJA3Profile(cgroupPath: string, profile: JA3Profile): Promise<void> {
     const mapPath = path.join(this.bpfFsPath, 'ja3_profiles');
 
     // Create binary representation
@@ -343,25 +433,19 @@ export class eBPFLoader {
     // Similar for extensions, curves, formats...
     // (truncated for brevity)
 
-    const tmpFile = `/tmp/ja3_profile_${pid}`;
-    await fs.writeFile(tmpFile, buffer);
-
-    try {
-      const keyBuf = Buffer.alloc(4);
-      keyBuf.writeUInt32LE(pid, 0);
+    const key = await this.cgroupKeyHex(cgroupPath);
+    await execAsync(`bpftool map update pinned ${mapPath} key hex ${key} value hex ${buffer.toString('hex')}`);
 
-      await execAsync(`bpftool map update pinned ${mapPath} key hex ${keyBuf.toString('hex')} value hex ${buffer.toString('hex')}`);
-
-      console.log(`✓ Updated JA3 profile for PID ${pid}`);
-    } finally {
-      await fs.unlink(tmpFile).catch(() => {});
-    }
+    console.log(`✓ Updated JA3 profile for cgroup ${cgroupPath}`);
   }
 
   /**
    * Load TCP fingerprint program
+   *
+   * The profile applies to every process in |cgroupPath|, one cgroup per
+   * browser instance (default: the cgroup root).
    */
-  async loadTCPFingerprint(profile: TCPProfile, pid?: number): Promise<eBPFProgramInfo> {
+  async loadTCPFingerprint(profile: TCPProfile, cgroupPath?: string): Promise<eBPFProgramInfo> {
     // Compile
     const objectFile = await this.compile('tcp_fingerprint.c', undefined, {
       optimization: 2,
@@ -375,19 +459,19 @@ export class eBPFLoader {
     });
 
     // Attach to cgroup
-    await this.attachToCgroup(progInfo.name);
+    const cgroup = cgroupPath || this.cgroupPath;
+    await this.attachToCgroup(progInfo.name, cgroup);
 
     // Update profile
-    const targetPid = pid || process.pid;
-    await this.updateTCPProfile(targetPid, profile);
+    await this.updateTCPProfile(cgroup, profile);
 
     return progInfo;
   }
 
   /**
-   * Load JA3 fingerprint program
+   * Load JA3 fingerprint program for every process in |cgroupPath|
    */
-  async loadJA3Fingerprint(profile: JA3Profile, pid?: number): Promise<eBPFProgramInfo> {
+  async loadJA3Fingerprint(profile: JA3Profile, cgroupPath?: string): Promise<eBPFProgramInfo> {
     // Compile
     const objectFile = await this.compile('tls_ja3.c', undefined, {
       optimization: 2,
@@ -401,15 +485,77 @@ export class eBPFLoader {
     });
 
     // Attach
-    await this.attachToCgroup(progInfo.name);
+    const cgroup = cgroupPath || this.cgroupPath;
+    await this.attachToCgroup(progInfo.name, cgroup);
 
     // Update profile
-    const targetPid = pid || process.pid;
-    await this.updateJA3Profile(targetPid, profile);
+    await this.updateJA3Profile(cgroup, profile);
 
     return progInfo;
   }
 
+  /**
+   * Count the bytes every cgroup under |cgroupPath| sends and receives
+   *
+   * Loads the cgroup_skb programs from cgroup_bytes.c and attaches them at
+   * egress and ingress. Read the counters with getCgroupBytes().
+   */
+  async loadByteCounters(cgroupPath?: string): Promise<eBPFProgramInfo[]> {
+    const objectFile = await this.compile('cgroup_bytes.c', undefined, {
+      optimization: 2,
+      debug: false
+    });
+
+    const dir = path.join(this.bpfFsPath, BYTE_COUNTERS_DIR);
+    try {
+      // loadall pins each program by function name and keeps the SEC()
+      // types; the object's one map goes in maps/
+      await execAsync(`bpftool prog loadall ${objectFile} ${dir} pinmaps ${path.join(dir, 'maps')}`);
+    } catch (error) {
+      throw new Error(`Failed to load byte counters: ${error}`);
+    }
+
+    const cgroup = cgroupPath || this.cgroupPath;
+    const programs: eBPFProgramInfo[] = [];
+    for (const [func, attachType] of [['cgroup_count_egress', 'egress'], ['cgroup_count_ingress', 'ingress']]) {
+      const { stdout } = await execAsync(`bpftool prog show pinned ${path.join(dir, func)}`);
+      const match = stdout.match(/id (\d+)/);
+      const prog: eBPFProgramInfo = {
+        fd: match ? parseInt(match[1], 10) : 0,
+        name: path.join(BYTE_COUNTERS_DIR, func),
+        type: `cgroup_skb/${attachType}`,
+        loaded: true,
+        attached: false
+      };
+      this.loadedPrograms.set(prog.name, prog);
+      await this.attachToCgroup(prog.name, cgroup, attachType);
+      programs.push(prog);
+    }
+
+    return programs;
+  }
+
+  /**
+   * Bytes a cgroup has sent and received since its first packet
+   */
+  async getCgroupBytes(cgroupPath: string): Promise<CgroupByteStats | null> {
+    const mapPath = path.join(this.bpfFsPath, BYTE_COUNTERS_DIR, 'maps', 'cgroup_bytes');
+
+    try {
+      const key = await this.cgroupKeyHex(cgroupPath);
+      const { stdout } = await execAsync(`bpftool map lookup pinned ${mapPath} key hex ${key} -j`);
+      const counters = sumPerCPUCounters([JSON.parse(stdout)]);
+
+      return {
+        txBytes: counters[0] || 0,
+        rxBytes: counters[1] || 0
+      };
+    } catch (error) {
+      // No entry until the cgroup's first packet
+      return null;
+    }
+  }
+
   /**
    * Get statistics from eBPF program
    */
@@ -418,12 +564,12 @@ export class eBPFLoader {
 
     try {
       const { stdout } = await execAsync(`bpftool map dump pinned ${mapPath} -j`);
-      const data = JSON.parse(stdout);
+      const counters = sumPerCPUCounters(JSON.parse(stdout));
 
       return {
-        connectionsModified: data[0]?.value?.[0] || 0,
-        packetsProcessed: data[0]?.value?.[1] || 0,
-        errors: data[0]?.value?.[2] || 0
+        connectionsModified: counters[0] || 0,
+        packetsProcessed: counters[1] || 0,
+        errors: counters[2] || 0
       };
     } catch (error) {
       console.error(`Failed to get stats: ${error}`);
@@ -444,7 +590,7 @@ export class eBPFLoader {
     try {
       // Detach if attached
       if (prog.attached && prog.attachPoint) {
-        await this.detachFromCgroup(programName);
+        await this.detachFromCgroup(programName, prog.attachPoint, prog.attachType);
       }
 
       // Unpin
@@ -37,6 +37,30 @@ export interface TCPProfile {
 
   /** TCP Fast Open enabled */
   fastOpen: boolean;
+
+  /** Congestion control algorithm, e.g. 'bbr' or 'cubic' (optional) */
+  congestionControl?: string;
+
+  /** Upper bound on the congestion window in segments (optional) */
+  sndCwndClamp?: number;
+
+  /** Minimum retransmit timeout in microseconds (optional) */
+  rtoMinUs?: number;
+
+  /** Longest an ACK may be delayed, in microseconds (optional) */
+  delackMaxUs?: number;
+
+  /** TCP_NOTSENT_LOWAT in bytes (optional) */
+  notsentLowat?: number;
+
+  /** SO_SNDBUF in bytes; unset leaves autotuning on (optional) */
+  sndBuf?: number;
+
+  /** SO_RCVBUF in bytes; unset leaves autotuning on (optional) */
+  rcvBuf?: number;
+
+  /** Egress pacing cap in bytes per second (optional) */
+  maxPacingRate?: number;
 }
 
 /**
@@ -78,6 +102,14 @@ export interface eBPFStats {
   errors: number;
 }
 
+/**
+ * Bytes a cgroup's sockets sent and received, IP headers included
+ */
+export interface CgroupByteStats {
+  txBytes: number;
+  rxBytes: number;
+}
+
 /**
  * Operating System Types
  */